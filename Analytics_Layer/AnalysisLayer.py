@@ -2,6 +2,7 @@
 # --- imports ---
 from __future__ import annotations
 import os
+import threading
 import psycopg
 import pandas as pd
 import numpy as np
@@ -9,6 +10,8 @@ from scipy.interpolate import griddata
 import plotly.graph_objects as go
 from typing import Dict, Optional, Tuple
 
+from CoverageEngine import CoverageEngine, bounds_from_zones
+
 # --- Zone Delimitation ---
 """ZONES: Dict[str, Dict[str, float]] = {
     "Cafe":     {"xmin": 260.0, "xmax": 310.0, "ymin": 336.0, "ymax": 400.0},
@@ -45,16 +48,16 @@ def get_conn():
 # DB download into a pandas table
 def load_data(hours: int = 24) -> pd.DataFrame:
     # SQL query
-    q = f"""
+    q = """
     SELECT device_id, rssi, down, up, lat, lon, ts
     FROM network_data
+    WHERE ts >= now() - make_interval(hours => %(hours)s)
     ORDER BY ts
     """
-    # WHERE ts >= now() - interval '{hours} hours'
 
     # Connection
     with get_conn() as conn:
-        df = pd.read_sql(q, conn)
+        df = pd.read_sql(q, conn, params={"hours": int(hours)})
 
     if df.empty:
         return df
@@ -69,6 +72,29 @@ def load_data(hours: int = 24) -> pd.DataFrame:
     df = df.dropna(subset=["lat", "lon", "down", "up"])       # Drops rows without coords or data
     return df
 
+# Survey rows (one per AP seen), same lat/lon/rssi columns so generate_heatmap(df, "rssi") maps one AP
+def load_ap_data(hours: int = 24, bssid: Optional[str] = None) -> pd.DataFrame:
+    q = """
+    SELECT device_id, bssid, rssi, channel, lat, lon, ts
+    FROM ap_survey
+    WHERE ts >= now() - make_interval(hours => %(hours)s)
+      AND (%(bssid)s::text IS NULL OR bssid = %(bssid)s::text)
+    ORDER BY ts
+    """
+
+    with get_conn() as conn:
+        df = pd.read_sql(q, conn, params={"hours": int(hours), "bssid": bssid})
+
+    if df.empty:
+        return df
+
+    df["ts"] = pd.to_datetime(df["ts"])
+    return df.dropna(subset=["lat", "lon", "rssi"])
+
+# Strongest AP per sample position, the "best server" coverage map
+def best_ap(df: pd.DataFrame) -> pd.DataFrame:
+    return df.loc[df.groupby(["device_id", "ts"])["rssi"].idxmax()]
+
 # --- Filter ---
 def filter_by_zone(df: pd.DataFrame, zone: str) -> pd.DataFrame:
     # Checks existing zone
@@ -196,3 +222,20 @@ def generate_heatmap(df: pd.DataFrame, metric: str = "rssi") -> str:
     fig.update_layout(title=f"Heatmap: {metric}")
 
     return fig.to_html(full_html=False, include_plotlyjs="cdn")
+
+
+# --- Incremental heat map ---
+# Keeps one CoverageEngine per window, each call only pulls rows newer than the last one
+# FastAPI runs sync handlers in a thread pool, so concurrent calls are serialized per engine
+_engines: Dict[int, CoverageEngine] = {}
+_engines_lock = threading.Lock()
+
+def generate_coverage_heatmap(metric: str = "rssi", hours: int = 24) -> str:
+    with _engines_lock:
+        if hours not in _engines:
+            _engines[hours] = CoverageEngine(hours=hours, bounds=bounds_from_zones(ZONES))
+        engine = _engines[hours]
+    with engine.lock:
+        with get_conn() as conn:
+            engine.refresh(conn)
+        return engine.heatmap(metric)
@@ -0,0 +1,348 @@
+# CoverageEngine.py — Incremental coverage heatmaps for the Analytics layer
+# --- imports ---
+from __future__ import annotations
+import threading
+import numpy as np
+import pandas as pd
+import plotly.graph_objects as go
+from scipy.spatial import Delaunay
+from typing import Dict, Optional, Tuple
+
+METRICS = ("rssi", "down", "up")
+
+# Default grid bounds (meters from the GPS reference): AnalysisLayer.ZONES spans lat 0..591 (y), lon 0..700 (x),
+# plus a 50 m margin so small negative offsets from the reference point are kept
+DEFAULT_BOUNDS = (-50.0, 641.0, -50.0, 750.0)    # (lat_min, lat_max, lon_min, lon_max)
+
+
+# Grid bounds enclosing every zone and the reference point, zones keep lon in x and lat in y (see AnalysisLayer.filter_by_zone)
+def bounds_from_zones(zones: Dict[str, Dict[str, float]], margin: float = 50.0) -> Tuple[float, float, float, float]:
+    return (
+        min(0.0, *(z["ymin"] for z in zones.values())) - margin,
+        max(0.0, *(z["ymax"] for z in zones.values())) + margin,
+        min(0.0, *(z["xmin"] for z in zones.values())) - margin,
+        max(0.0, *(z["xmax"] for z in zones.values())) + margin,
+    )
+
+
+# --- Columnar sample cache ---
+class SampleCache:
+    """
+    Append-only columnar cache of network_data rows, kept in ingest (id) order.
+    Columns are numpy arrays grown by doubling so appends are amortized O(1).
+    Rows older than the window are evicted from the front by moving `start`.
+    """
+
+    COLUMNS = ("lat", "lon") + METRICS
+
+    def __init__(self, capacity: int = 1024):
+        self.start = 0
+        self.size = 0
+        self.ts = np.empty(capacity, dtype="datetime64[ns]")
+        self.cols: Dict[str, np.ndarray] = {c: np.empty(capacity) for c in self.COLUMNS}
+
+    def __len__(self) -> int:
+        return self.size - self.start
+
+    def _reserve(self, extra: int):
+        # Drops evicted rows before growing, so the buffer tracks the live window
+        live = self.size - self.start
+        need = live + extra
+        cap = len(self.ts)
+        if self.start == 0 and need <= cap:
+            return
+
+        new_cap = cap
+        while new_cap < need:
+            new_cap *= 2
+
+        ts = np.empty(new_cap, dtype="datetime64[ns]")
+        ts[:live] = self.ts[self.start:self.size]
+        self.ts = ts
+        for c in self.COLUMNS:
+            arr = np.empty(new_cap)
+            arr[:live] = self.cols[c][self.start:self.size]
+            self.cols[c] = arr
+        self.start, self.size = 0, live
+
+    # Appends a batch (DataFrame with ts + COLUMNS), returns the slice it occupies
+    def append(self, df: pd.DataFrame) -> slice:
+        n = len(df)
+        self._reserve(n)
+        lo, hi = self.size, self.size + n
+        self.ts[lo:hi] = pd.to_datetime(df["ts"]).values
+        for c in self.COLUMNS:
+            self.cols[c][lo:hi] = pd.to_numeric(df[c], errors="coerce").values if c in df else np.nan
+        self.size = hi
+        return slice(lo, hi)
+
+    # Evicts the leading rows with ts < cutoff, returns the slice that was dropped
+    # Rows arrive roughly in ts order, a late row leaves the window once the rows ahead of it do
+    def evict_before(self, cutoff: np.datetime64, chunk: int = 4096) -> slice:
+        end = self.start
+        while end < self.size:
+            keep = np.flatnonzero(self.ts[end:min(end + chunk, self.size)] >= cutoff)
+            if len(keep):
+                end += int(keep[0])
+                break
+            end = min(end + chunk, self.size)
+        dropped = slice(self.start, end)
+        self.start = end
+        return dropped
+
+    def column(self, name: str, rows: slice) -> np.ndarray:
+        return self.ts[rows] if name == "ts" else self.cols[name][rows]
+
+
+# --- Pre-binned spatial grid ---
+class CoverageGrid:
+    """
+    Fixed nx x ny grid over (lat, lon) holding per-cell sums and counts of each metric.
+    Samples are added/removed in O(batch) and touched cells are marked dirty.
+    The rendered surface keeps cell means where there is data and fills empty
+    cells by linear interpolation over the populated cell centres.
+    """
+
+    # Re-triangulate once this fraction of populated cells appeared since the last build
+    REBUILD_FRACTION = 0.02
+
+    def __init__(self, bounds: Tuple[float, float, float, float] = DEFAULT_BOUNDS, nx: int = 100, ny: int = 100):
+        self.lat_min, self.lat_max, self.lon_min, self.lon_max = bounds
+        self.nx, self.ny = nx, ny
+        self.xi = np.linspace(self.lat_min, self.lat_max, nx)
+        self.yi = np.linspace(self.lon_min, self.lon_max, ny)
+
+        cells = nx * ny
+        self.sums = {m: np.zeros(cells) for m in METRICS}
+        self.counts = {m: np.zeros(cells, dtype=np.int64) for m in METRICS}
+        self.dirty = {m: np.zeros(cells, dtype=bool) for m in METRICS}
+        self.surface = {m: np.full(cells, np.nan) for m in METRICS}
+
+        # Interpolation plan per metric: populated mask and barycentric weights for empty cells
+        self._populated = {m: np.zeros(cells, dtype=bool) for m in METRICS}
+        self._plan: Dict[str, Optional[Tuple[np.ndarray, np.ndarray, np.ndarray]]] = {m: None for m in METRICS}
+        self._gained = {m: 0 for m in METRICS}     # Cells populated since the last triangulation
+        self._last_build: Optional[Tuple[np.ndarray, object]] = None
+        self.rebuilds = 0
+        self.out_of_bounds = 0      # Samples in the current window that fall outside the grid
+
+    # Flat cell index for each sample, -1 when outside the grid
+    def cell_index(self, lat: np.ndarray, lon: np.ndarray) -> np.ndarray:
+        fx = (lat - self.lat_min) / (self.lat_max - self.lat_min) * (self.nx - 1)
+        fy = (lon - self.lon_min) / (self.lon_max - self.lon_min) * (self.ny - 1)
+        ix = np.rint(fx)
+        iy = np.rint(fy)
+        ok = (ix >= 0) & (ix < self.nx) & (iy >= 0) & (iy < self.ny)
+        idx = np.full(len(lat), -1, dtype=np.int64)
+        idx[ok] = iy[ok].astype(np.int64) * self.nx + ix[ok].astype(np.int64)
+        return idx
+
+    # Adds (sign=+1) or removes (sign=-1) a batch of samples
+    def accumulate(self, lat: np.ndarray, lon: np.ndarray, values: Dict[str, np.ndarray], sign: int = 1):
+        idx = self.cell_index(lat, lon)
+        inside = idx >= 0
+        self.out_of_bounds += sign * int((~inside).sum())
+
+        for m in METRICS:
+            v = values[m]
+            ok = inside & ~np.isnan(v)
+            cells = idx[ok]
+            if not len(cells):
+                continue
+            self.sums[m] += sign * np.bincount(cells, weights=v[ok], minlength=len(self.sums[m]))
+            self.counts[m] += sign * np.bincount(cells, minlength=len(self.counts[m]))
+            self.dirty[m][cells] = True
+
+    # Re-evaluates dirty cells only, returns how many cells were recomputed
+    def refresh(self, metric: str) -> int:
+        dirty = self.dirty[metric]
+        if not dirty.any():
+            return 0
+
+        counts = self.counts[metric]
+        surface = self.surface[metric]
+        populated = counts > 0
+
+        # Direct cell means for the dirty cells
+        d = np.flatnonzero(dirty)
+        with np.errstate(invalid="ignore", divide="ignore"):
+            surface[d] = np.where(populated[d], self.sums[metric][d] / counts[d], np.nan)
+
+        was = self._populated[metric]
+        gained = d[populated[d] & ~was[d]]
+        lost = (~populated[d] & was[d]).any()
+        self._populated[metric] = populated
+        plan = self._plan[metric]
+
+        # Cells lost data (triangle vertices gone) or too many new cells: re-triangulate, refill every empty cell
+        self._gained[metric] += len(gained)
+        if lost or (plan is None and len(gained)) or self._gained[metric] > self.REBUILD_FRACTION * populated.sum():
+            plan = self._plan[metric] = self._shared_plan(populated)
+            self._gained[metric] = 0
+            surface[~populated] = np.nan
+            rows = np.ones(len(plan[0]), dtype=bool) if plan is not None else None
+        # Only new cells: drop them from the targets, old triangles still interpolate between populated cells
+        # Then refresh just the empty cells whose triangle uses a dirty cell
+        else:
+            if plan is not None and len(gained):
+                keep = ~np.isin(plan[0], gained)
+                plan = self._plan[metric] = (plan[0][keep], plan[1][keep], plan[2][keep])
+            rows = dirty[plan[1]].any(axis=1) if plan is not None else None
+
+        filled = 0
+        if rows is not None and rows.any():
+            targets, vertices, weights = plan[0][rows], plan[1][rows], plan[2][rows]
+            surface[targets] = (weights * surface[vertices]).sum(axis=1)
+            filled = len(targets)
+
+        dirty[:] = False
+        return len(d) + filled
+
+    # Metrics usually share a populated set, triangulate it once
+    def _shared_plan(self, populated: np.ndarray):
+        if self._last_build is not None and np.array_equal(self._last_build[0], populated):
+            return self._last_build[1]
+        plan = self._build_plan(populated)
+        self._last_build = (populated, plan)
+        self.rebuilds += 1
+        return plan
+
+    # Delaunay triangulation of populated cell centres, barycentric weights for each empty cell inside the hull
+    # Cells outside the hull are left out and stay NaN, like griddata(method="linear")
+    def _build_plan(self, populated: np.ndarray):
+        src = np.flatnonzero(populated)
+        if len(src) < 3:
+            return None
+
+        iy, ix = np.divmod(np.arange(self.nx * self.ny), self.nx)
+        pts = np.column_stack((ix, iy)).astype(float)
+        try:
+            tri = Delaunay(pts[src])
+        except Exception:       # Collinear / degenerate layouts
+            return None
+
+        empty = np.flatnonzero(~populated)
+        simplex = tri.find_simplex(pts[empty])
+        inside = simplex >= 0
+        empty, simplex = empty[inside], simplex[inside]
+
+        # Same weights scipy's LinearNDInterpolator uses
+        T = tri.transform[simplex]
+        b = np.einsum("ijk,ik->ij", T[:, :2, :], pts[empty] - T[:, 2, :])
+        weights = np.column_stack((b, 1.0 - b.sum(axis=1)))
+        vertices = src[tri.simplices[simplex]]
+        return empty, vertices, weights
+
+    def grid(self, metric: str) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        return self.xi, self.yi, self.surface[metric].reshape(self.ny, self.nx)
+
+
+# --- Engine ---
+class CoverageEngine:
+    """
+    Keeps a SampleCache and a CoverageGrid in sync with network_data.
+    refresh() pulls only rows past the id watermark, bins them,
+    evicts rows that fell out of the time window, and re-interpolates dirty cells.
+    """
+
+    # Ids re-read behind the watermark, catches inserts that committed after a higher id was fetched
+    ID_OVERLAP = 1000
+
+    def __init__(self, hours: Optional[float] = 24, bounds: Tuple[float, float, float, float] = DEFAULT_BOUNDS,
+                 nx: int = 100, ny: int = 100):
+        self.hours = hours
+        self.cache = SampleCache()
+        self.grid = CoverageGrid(bounds, nx, ny)
+        self.stats = {"fetched": 0, "evicted": 0, "cells": 0}
+        self.lock = threading.Lock()    # Not thread-safe, shared engines hold it across refresh() + heatmap()
+
+        # Watermark on network_data.id (insert order), not on the device-supplied ts
+        self.max_id: Optional[int] = None
+        self._recent_ids = np.empty(0, dtype=np.int64)     # Ids above max_id - ID_OVERLAP already ingested
+
+    # Adds a batch of rows (device_id, rssi, down, up, lat, lon, ts), in insert order
+    def ingest(self, df: pd.DataFrame):
+        self.stats["fetched"] = 0
+        if df.empty:
+            return
+        df = df.dropna(subset=["lat", "lon", "down", "up"])
+        rows = self.cache.append(df)
+        self._apply(rows, +1)
+        self.stats["fetched"] = len(df)
+
+    # Drops samples older than the window relative to `now`
+    def evict(self, now: Optional[np.datetime64] = None):
+        if self.hours is None or not len(self.cache):
+            self.stats["evicted"] = 0
+            return
+        now = now if now is not None else np.datetime64(pd.Timestamp.now().to_datetime64())
+        rows = self.cache.evict_before(now - np.timedelta64(int(self.hours * 3_600_000), "ms"))
+        self._apply(rows, -1)
+        self.stats["evicted"] = rows.stop - rows.start
+
+    def _apply(self, rows: slice, sign: int):
+        if rows.stop <= rows.start:
+            return
+        values = {m: self.cache.column(m, rows) for m in METRICS}
+        self.grid.accumulate(self.cache.column("lat", rows), self.cache.column("lon", rows), values, sign)
+
+    # Pulls rows inserted since the last fetch, whatever their ts
+    def fetch(self, conn) -> pd.DataFrame:
+        if self.max_id is None:
+            q = """
+            SELECT id, device_id, rssi, down, up, lat, lon, ts
+            FROM network_data
+            WHERE %(hours)s::float8 IS NULL OR ts >= now() - make_interval(secs => %(hours)s::float8 * 3600)
+            ORDER BY id
+            """
+            params = {"hours": self.hours}
+        else:
+            q = """
+            SELECT id, device_id, rssi, down, up, lat, lon, ts
+            FROM network_data
+            WHERE id > %(lo)s
+            ORDER BY id
+            """
+            params = {"lo": self.max_id - self.ID_OVERLAP}
+
+        with conn.cursor() as cur:
+            cur.execute(q, params)
+            rows = cur.fetchall()
+        df = pd.DataFrame(rows, columns=["id", "device_id", "rssi", "down", "up", "lat", "lon", "ts"])
+        return self._new_rows(df)
+
+    # Drops rows of the overlap already ingested and advances the watermark
+    def _new_rows(self, df: pd.DataFrame) -> pd.DataFrame:
+        if df.empty:
+            return df
+        ids = df["id"].to_numpy(dtype=np.int64)
+        fresh = ~np.isin(ids, self._recent_ids)
+
+        self.max_id = max(self.max_id or 0, int(ids.max()))
+        recent = np.concatenate((self._recent_ids, ids[fresh]))
+        self._recent_ids = recent[recent > self.max_id - self.ID_OVERLAP]
+        return df[fresh]
+
+    # One incremental step: fetch, bin, evict, re-interpolate dirty cells
+    def refresh(self, conn=None, now: Optional[np.datetime64] = None):
+        if conn is not None:
+            self.ingest(self.fetch(conn))
+        self.evict(now)
+        self.stats["cells"] = sum(self.grid.refresh(m) for m in METRICS)
+        return self.stats
+
+    def heatmap(self, metric: str = "rssi") -> str:
+        if metric not in METRICS:
+            raise ValueError("metric must be 'down', 'up', or 'rssi'")
+        self.grid.refresh(metric)
+        if not len(self.cache):
+            return "<h1>No data</h1>"
+
+        xi, yi, Zi = self.grid.grid(metric)
+        fig = go.Figure(data=go.Heatmap(x=xi, y=yi, z=Zi))
+        title = f"Heatmap: {metric}"
+        if self.grid.out_of_bounds:
+            title += f" ({self.grid.out_of_bounds} of {len(self.cache)} samples outside the grid, not shown)"
+        fig.update_layout(title=title)
+
+        return fig.to_html(full_html=False, include_plotlyjs="cdn")
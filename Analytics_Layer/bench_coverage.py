@@ -0,0 +1,101 @@
+# bench_coverage.py — Per-refresh cost of CoverageEngine vs. full griddata rebuild
+# Usage: python bench_coverage.py [--samples 1000000] [--batch 200] [--refreshes 50]
+# --- imports ---
+from __future__ import annotations
+import argparse
+import time
+import numpy as np
+import pandas as pd
+from scipy.interpolate import griddata
+
+from CoverageEngine import CoverageEngine, DEFAULT_BOUNDS
+
+
+# --- Synthetic data ---
+# Samples inside the default grid bounds, one every `step_ms` starting at `t0`
+def syn_batch(n: int, t0: np.datetime64, step_ms: int = 50, rng: np.random.Generator | None = None) -> pd.DataFrame:
+    rng = rng or np.random.default_rng(0)
+    lat_min, lat_max, lon_min, lon_max = DEFAULT_BOUNDS
+
+    # Walkers cluster around buildings, leaving gaps to interpolate
+    centres = rng.uniform((lat_min, lon_min), (lat_max, lon_max), size=(40, 2))
+    pick = centres[rng.integers(0, len(centres), n)]
+    pos = pick + rng.normal(0, 15, size=(n, 2))
+
+    return pd.DataFrame({
+        "device_id": rng.integers(1, 20, n).astype(str),
+        "rssi": rng.uniform(-85, -40, n),
+        "down": rng.uniform(0.02, 1.5, n),
+        "up":   rng.uniform(0.01, 0.8, n),
+        "lat":  pos[:, 0],
+        "lon":  pos[:, 1],
+        "ts":   t0 + np.arange(n) * np.timedelta64(step_ms, "ms"),
+    })
+
+
+def ms(t: float) -> str:
+    return f"{t * 1000:8.2f} ms"
+
+
+# --- Benchmark ---
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--samples", type=int, default=1_000_000)   # Initial dataset size
+    ap.add_argument("--batch", type=int, default=200)           # New rows per refresh
+    ap.add_argument("--refreshes", type=int, default=50)
+    ap.add_argument("--no-baseline", action="store_true")       # Skip the full griddata rebuild
+    args = ap.parse_args()
+
+    rng = np.random.default_rng(42)
+    step_ms = 50
+    t0 = np.datetime64("2025-01-01T00:00:00", "ns")
+    base = syn_batch(args.samples, t0, step_ms, rng)
+    now = base["ts"].iloc[-1]
+
+    # Sliding window spanning exactly the initial dataset: each refresh evicts as many rows as it adds
+    hours = args.samples * step_ms / 3.6e6
+    engine = CoverageEngine(hours=hours)
+
+    start = time.perf_counter()
+    engine.ingest(base)
+    engine.refresh(now=now.to_datetime64())
+    cold = time.perf_counter() - start
+
+    # Incremental refreshes
+    times, cells, evicted = [], [], []
+    for i in range(args.refreshes):
+        t_next = now + pd.Timedelta(milliseconds=step_ms)
+        batch = syn_batch(args.batch, t_next.to_datetime64(), step_ms, rng)
+        now = batch["ts"].iloc[-1]
+
+        start = time.perf_counter()
+        engine.ingest(batch)
+        stats = engine.refresh(now=now.to_datetime64())
+        times.append(time.perf_counter() - start)
+        cells.append(stats["cells"])
+        evicted.append(stats["evicted"])
+
+    t = np.array(times)
+    print(f"samples={len(engine.cache)} grid={engine.grid.nx}x{engine.grid.ny} batch={args.batch}")
+    print(f"cold build        {ms(cold)}")
+    print(f"refresh p50       {ms(np.percentile(t, 50))}")
+    print(f"refresh p95       {ms(np.percentile(t, 95))}")
+    print(f"refresh max       {ms(t.max())}")
+    print(f"cells/refresh     {np.mean(cells):8.0f}")
+    print(f"evicted/refresh   {np.mean(evicted):8.0f}")
+    print(f"re-triangulations {engine.grid.rebuilds:8d}")
+
+    # Baseline: what generate_heatmap() does on every call
+    if not args.no_baseline:
+        x, y, z = base["lat"].values, base["lon"].values, base["rssi"].values
+        xi = np.linspace(x.min(), x.max(), 100)
+        yi = np.linspace(y.min(), y.max(), 100)
+        Xi, Yi = np.meshgrid(xi, yi)
+
+        start = time.perf_counter()
+        griddata((x, y), z, (Xi, Yi), method="linear")
+        print(f"griddata rebuild  {ms(time.perf_counter() - start)}")
+
+
+if __name__ == "__main__":
+    main()
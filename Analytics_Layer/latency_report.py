@@ -0,0 +1,103 @@
+# latency_report.py — Per-hop latency percentiles and sample loss per device
+# Usage: python latency_report.py [--hours 24] [--device ESP32_01]
+# --- imports ---
+from __future__ import annotations
+import argparse
+import pandas as pd
+from typing import Optional
+
+from AnalysisLayer import get_conn
+
+# Hop name -> (start column, end column), all UTC epoch ms
+HOPS = {
+    "sample->publish":  ("t_sample_ms", "t_publish_ms"),    # Probes + payload build, device clock only
+    "publish->receive": ("t_publish_ms", "t_receive_ms"),   # WiFi + broker, device vs. server clock
+    "receive->commit":  ("t_receive_ms", "t_commit_ms"),    # Parsing + insert + commit (with retries), server clock only
+    "end-to-end":       ("t_sample_ms", "t_commit_ms"),
+}
+PERCENTILES = (0.50, 0.95, 0.99)
+
+
+# --- Download ---
+def load_traces(hours: int = 24, device: Optional[str] = None) -> pd.DataFrame:
+    # boot_in_window: no row of the boot precedes the window, so its seq 0 belongs to it
+    q = """
+    WITH recent AS (
+        SELECT device_id, seq, boot_id, t_sample_ms, t_publish_ms, t_receive_ms, t_commit_ms
+        FROM network_data
+        WHERE seq IS NOT NULL
+          AND t_receive_ms >= (extract(epoch FROM now()) * 1000)::bigint - %(hours)s::bigint * 3600000
+          AND (%(device)s::text IS NULL OR device_id = %(device)s::text)
+    ), older AS (
+        SELECT DISTINCT device_id, boot_id
+        FROM network_data
+        WHERE seq IS NOT NULL
+          AND t_receive_ms < (extract(epoch FROM now()) * 1000)::bigint - %(hours)s::bigint * 3600000
+          AND (device_id, boot_id) IN (SELECT device_id, boot_id FROM recent)
+    )
+    SELECT r.*, o.boot_id IS NULL AS boot_in_window
+    FROM recent r LEFT JOIN older o USING (device_id, boot_id)
+    """
+    with get_conn() as conn:
+        return pd.read_sql(q, conn, params={"hours": int(hours), "device": device})
+
+
+# --- Statistics ---
+# Latency percentiles (ms) per device and hop
+def hop_latency(df: pd.DataFrame) -> pd.DataFrame:
+    rows = []
+    for device, g in df.groupby("device_id"):
+        for hop, (a, b) in HOPS.items():
+            d = (g[b] - g[a]).dropna()      # Missing stamps (device clock not set yet) are skipped
+            if d.empty:
+                continue
+            q = d.quantile(PERCENTILES)
+            rows.append({
+                "device_id": device, "hop": hop, "n": len(d),
+                "p50": q[0.50], "p95": q[0.95], "p99": q[0.99],
+            })
+    return pd.DataFrame(rows, columns=["device_id", "hop", "n", "p50", "p95", "p99"])
+
+
+# Loss from sequence gaps, seq restarts at 0 every boot so each (device, boot) is counted separately.
+# Boots that started inside the window count from seq 0, older ones from their first row in the window.
+def sample_loss(df: pd.DataFrame) -> pd.DataFrame:
+    df = df.dropna(subset=["seq"])
+    g = df.groupby(["device_id", "boot_id"])
+    seq = g["seq"]
+    first = seq.min()
+    if "boot_in_window" in df:
+        first = first.where(~g["boot_in_window"].all(), 0)
+    per_boot = pd.DataFrame({
+        "received": seq.nunique(),
+        "expected": seq.max() + 1 - first,
+        "duplicates": seq.size() - seq.nunique(),
+    }).reset_index()
+
+    out = per_boot.groupby("device_id")[["received", "expected", "duplicates"]].sum().reset_index()
+    out["lost"] = out["expected"] - out["received"]
+    out["loss_pct"] = 100.0 * out["lost"] / out["expected"]
+    return out
+
+
+# --- Report ---
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--hours", type=int, default=24)
+    ap.add_argument("--device", default=None)
+    args = ap.parse_args()
+
+    df = load_traces(args.hours, args.device)
+    if df.empty:
+        print("No traced samples in range")
+        return
+
+    pd.set_option("display.width", 120)
+    print("Latency (ms)")
+    print(hop_latency(df).to_string(index=False, float_format="%.0f"))
+    print("\nLoss")
+    print(sample_loss(df).to_string(index=False, float_format="%.2f"))
+
+
+if __name__ == "__main__":
+    main()
@@ -2,7 +2,7 @@ import { useMetrics } from "../hooks/useMetrics";
 import { Activity } from "lucide-react";
 
 export function IoTDashboard() {
-  const metrics = useMetrics();   // <-- get live metrics from Python
+  const metrics = useMetrics();   // <-- live metrics pushed from Python (SSE)
 
   return (
     <div className="space-y-6">
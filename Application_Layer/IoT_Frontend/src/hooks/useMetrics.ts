@@ -1,7 +1,17 @@
 import { useEffect, useState } from "react";
 
+const STREAM_URL = "http://172.20.10.10:8080/stream"; // Franco
+// const STREAM_URL = "http://10.50.77.144:8080/stream";
+
+type Metrics = {
+  avg_download: number;
+  avg_upload: number;
+  num_queries: number;
+  current_time: string;
+};
+
 export function useMetrics() {
-  const [metrics, setMetrics] = useState({
+  const [metrics, setMetrics] = useState<Metrics>({
     avg_download: 0,
     avg_upload: 0,
     num_queries: 0,
@@ -9,15 +19,24 @@ export function useMetrics() {
   });
 
   useEffect(() => {
-    const interval = setInterval(() => {
-      fetch("http://172.20.10.10:8080/metrics") // Franco
-      // fetch("http://10.50.77.144:8080/metrics")
-        .then(res => res.json())
-        .then(setMetrics)
-        .catch(() => {});
+    // Server pushes a snapshot on connect, then one update per ingested sample
+    const source = new EventSource(STREAM_URL);
+    const apply = (e: MessageEvent) => {
+      const { metrics: m } = JSON.parse(e.data);
+      setMetrics(prev => ({ ...m, current_time: prev.current_time || m.current_time }));
+    };
+    source.addEventListener("snapshot", apply);
+    source.addEventListener("update", apply);
+
+    // Clock ticks locally, no request needed
+    const clock = setInterval(() => {
+      setMetrics(prev => ({ ...prev, current_time: new Date().toLocaleTimeString("en-GB") }));
     }, 1000);
 
-    return () => clearInterval(interval);
+    return () => {
+      source.close();
+      clearInterval(clock);
+    };
   }, []);
 
   return metrics;
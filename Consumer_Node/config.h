@@ -22,6 +22,7 @@ const char* MQTT_PASS_VAR      = "";
 
 // Channel ID
 const char* CHANNEL_ID = "test";        // Define channel as test channel
+const bool  USE_SUMMARY = true;         // Subscribe to channels/<id>/summary instead of the raw publish topic
 
 // Device ID
 const char* DEVICE_ID = "ESP32_01";     // Unique machine identifier
@@ -340,8 +340,8 @@ void connectMQTT() {
         if (mqttClient.connect(MQTT_CLIENT_ID_VAR, MQTT_USER_VAR, MQTT_PASS_VAR)) {
             Serial.println("OK");
 
-            // Subscribe to the same topic publishers send to:
-            String topic = String("channels/") + CHANNEL_ID + "/publish";
+            // Subscribe to the summarizer's fixed-rate topic, or to the same topic publishers send to
+            String topic = String("channels/") + CHANNEL_ID + (USE_SUMMARY ? "/summary" : "/publish");
             mqttClient.subscribe(topic.c_str());
             Serial.print("Subscribed to: ");
             Serial.println(topic);
@@ -355,6 +355,7 @@ void connectMQTT() {
 
 void setupMQTT() {
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+    mqttClient.setBufferSize(512);      // Raw survey samples (aps=) exceed the 256 B default and are dropped silently
     mqttClient.setCallback(mqttCallback);
     connectMQTT();
 }
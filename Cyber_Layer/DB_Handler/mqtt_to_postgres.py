@@ -2,6 +2,7 @@
 # --- Imports ---
 import logging
 import os
+import time
 from datetime import datetime
 from urllib.parse import parse_qsl
 
@@ -15,6 +16,7 @@ from tenacity import retry, stop_after_attempt, wait_exponential
 MQTT_BROKER = os.getenv("MQTT_BROKER", "localhost")         # Location of the Mqtt broker
 MQTT_PORT = int(os.getenv("MQTT_PORT", 1883))               # Port of the broker
 MQTT_TOPIC = os.getenv("MQTT_TOPIC", "channels/+/publish")  # Structure of the many channels
+BOOT_TOPIC = os.getenv("BOOT_TOPIC", "channels/+/boot/+")   # Retained boot metrics, one per device
 MQTT_QOS = 1
 # PgAdmin access variables
 PG_HOST = os.getenv("PG_HOST", "localhost")                 # Location of the database
@@ -55,8 +57,10 @@ def init_pg_pool():     # Creates a connection pool, just one
 def insert_row(data):
     """
     Insert dictionary:
-    { device_id, rssi, down, up, lat, lon, ts }
+    { device_id, rssi, down, up, lat, lon, ts, aps, seq, boot_id, t_sample_ms, t_publish_ms, t_receive_ms }
+    t_commit_ms is stamped once conn.commit() returns, on the same clock as t_receive_ms
     """
+    ts = data.get("ts") or datetime.utcnow()    # If timestamp is missing
 
     try:
         # Retrieves a pooled DB connection
@@ -66,8 +70,10 @@ def insert_row(data):
                 cur.execute(
                     """
                     INSERT INTO network_data
-                        (device_id, rssi, down, up, lat, lon, ts)
-                    VALUES (%s,%s,%s,%s,%s,%s,%s)
+                        (device_id, rssi, down, up, lat, lon, ts,
+                         seq, boot_id, t_sample_ms, t_publish_ms, t_receive_ms)
+                    VALUES (%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s)
+                    RETURNING id
                     """,
                     (
                         data.get("device_id"),
@@ -76,10 +82,42 @@ def insert_row(data):
                         data.get("up"),
                         data.get("lat"),
                         data.get("lon"),
-                        data.get("ts") or datetime.utcnow(),    # If timestamp is missing
+                        ts,
+                        data.get("seq"),
+                        data.get("boot_id"),
+                        data.get("t_sample_ms"),
+                        data.get("t_publish_ms"),
+                        data.get("t_receive_ms"),
                     ),
                 )
+                row_id = cur.fetchone()[0]
+                # Survey results, one row per AP at the sample's position
+                if data.get("aps"):
+                    cur.executemany(
+                        """
+                        INSERT INTO ap_survey
+                            (device_id, ts, bssid, rssi, channel, lat, lon)
+                        VALUES (%s,%s,%s,%s,%s,%s,%s)
+                        ON CONFLICT DO NOTHING
+                        """,
+                        [
+                            (data.get("device_id"), ts, ap["bssid"], ap["rssi"], ap["channel"], data.get("lat"), data.get("lon"))
+                            for ap in data["aps"]
+                        ],
+                    )
                 conn.commit()       # Commits transaction
+                committed_ms = int(time.time() * 1000)
+
+                # Trace stamp in its own transaction, the row is already durable.
+                # Indexed by id and no WAL flush wait, so tracing does not add a second full commit
+                if data.get("seq") is not None:
+                    try:
+                        cur.execute("SET LOCAL synchronous_commit = off")
+                        cur.execute("UPDATE network_data SET t_commit_ms = %s WHERE id = %s", (committed_ms, row_id))
+                        conn.commit()
+                    except Exception as e:
+                        conn.rollback()     # Not retried, re-running the insert would hit the primary key
+                        logging.warning("Commit stamp failed for %s: %s", data.get("device_id"), e)
         # Logs succesful insertion
         logging.info("Inserted: %s @ %s", data.get("device_id"), data.get("ts"))
 
@@ -90,11 +128,65 @@ def insert_row(data):
 
 
 
+@retry(stop=stop_after_attempt(5), wait=wait_exponential(min=1, max=10))
+def insert_boot(data):
+    """
+    Insert dictionary:
+    { device_id, boot_id, boot_ms, wifi }
+    The message is retained, so the broker resends it on every reconnect: one row per (device, boot)
+    """
+    try:
+        with pool.connection() as conn:
+            with conn.cursor() as cur:
+                cur.execute(
+                    """
+                    INSERT INTO boot_metrics (device_id, boot_id, boot_ms, wifi)
+                    VALUES (%s,%s,%s,%s)
+                    ON CONFLICT DO NOTHING
+                    """,
+                    (data["device_id"], data["boot_id"], data["boot_ms"], data["wifi"]),
+                )
+                conn.commit()
+        logging.info("Boot: %s #%s %s ms", data["device_id"], data["boot_id"], data["boot_ms"])
+
+    except Exception as e:
+        logging.exception("Boot insert failed, will retry: %s", e)
+        raise
+
+
 # --- Payload parsing ---
+def parse_aps(raw):
+    """
+    Parses survey results like:
+    aabbccddeeff,-67,6|112233445566,-80,11
+    """
+    aps = []
+    for entry in raw.split("|"):
+        try:
+            bssid, rssi, channel = entry.split(",")
+            aps.append({
+                "bssid": ":".join(bssid[i:i + 2] for i in range(0, 12, 2)),
+                "rssi": int(rssi),
+                "channel": int(channel),
+            })
+        except ValueError:
+            logging.warning("Bad survey entry: %s", entry)
+    return aps
+
+
+def to_int(raw):
+    try:
+        return int(raw)
+    except (TypeError, ValueError):
+        return None
+
+
 def parse_payload(payload_str):
     """
     Parses MQTT payload like:
     field1=rssi&field2=down&...&field7=ts? or field7=unix
+    optional aps=<bssid>,<rssi>,<channel>|...
+    optional seq=<n>&boot=<id>&t_s=<sample ms>&t_p=<publish ms> (UTC epoch ms, 0 = device clock not set)
     """
     pairs = dict(parse_qsl(payload_str))    # Decodes URL-encoded key/value pairs
 
@@ -107,6 +199,11 @@ def parse_payload(payload_str):
         "lon":  float(pairs["field5"]) if "field5" in pairs else None,
         "ts": None,
         "device_id": pairs.get("field7"),
+        "aps": parse_aps(pairs["aps"]) if pairs.get("aps") else [],
+        "seq": to_int(pairs.get("seq")),
+        "boot_id": to_int(pairs.get("boot")),
+        "t_sample_ms": to_int(pairs.get("t_s")) or None,
+        "t_publish_ms": to_int(pairs.get("t_p")) or None,
     }
 
     # parse timestamp from field6
@@ -130,23 +227,50 @@ def parse_payload(payload_str):
     return result
 
 
+def parse_boot(device_id, payload_str):
+    """
+    Parses boot metric payload like:
+    boot_ms=<ms>&boot=<id>&wifi=cached|full
+    """
+    pairs = dict(parse_qsl(payload_str))
+    result = {
+        "device_id": device_id,
+        "boot_id": to_int(pairs.get("boot")),
+        "boot_ms": to_int(pairs.get("boot_ms")),
+        "wifi": pairs.get("wifi"),
+    }
+    return result if result["boot_id"] is not None else None    # Older firmware, no boot id to key on
+
+
 # --- MQTT callbacks ---
 # Connects to the mqtt broker
 def on_connect(client, userdata, flags, rc):
     if rc == 0:
-        logging.info("MQTT connected OK. Subscribing to %s", MQTT_TOPIC)
-        client.subscribe(MQTT_TOPIC, qos=MQTT_QOS)
+        logging.info("MQTT connected OK. Subscribing to %s, %s", MQTT_TOPIC, BOOT_TOPIC)
+        client.subscribe([(MQTT_TOPIC, MQTT_QOS), (BOOT_TOPIC, MQTT_QOS)])
     else:
         logging.error("MQTT connection error rc=%s", rc)
 
 # Decodes Mqtt message, logs the message
 def on_message(client, userdata, msg):
+    received_ms = int(time.time() * 1000)   # Before parsing and DB work, so they count toward receive -> commit
     try:
         payload = msg.payload.decode("utf-8", errors="ignore")
         logging.info("MQTT msg | topic=%s | payload=%s", msg.topic, payload)
 
+        # channels/<id>/boot/<device>
+        parts = msg.topic.split("/")
+        if len(parts) == 4 and parts[2] == "boot":
+            boot = parse_boot(parts[3], payload)
+            if boot:
+                insert_boot(boot)
+            else:
+                logging.warning("Could not parse boot metric: %s", payload)
+            return
+
         parsed = parse_payload(payload)     # Parses payload into the dictionary
         if parsed:
+            parsed["t_receive_ms"] = received_ms
             insert_row(parsed)              # Inserts into the database
         else:
             logging.warning("Could not parse payload: %s", payload) # Logs error if parsing fails
@@ -1,11 +1,14 @@
 # Unified server containing everything so far
 from flask import Flask, request, send_file, jsonify, Response
 from datetime import datetime
+from urllib.parse import parse_qsl
+from collections import deque
 from flask_cors import CORS
+import paho.mqtt.client as mqtt
 import plotly.express as px
 import plotly.io as pio
 from PIL import Image
-import time, os, io
+import time, os, io, json, queue, threading
 import pandas as pd
 import numpy as np
 import psycopg
@@ -25,6 +28,13 @@ PG_USER = "postgres"
 PG_PASS = "CMF-THW-PNK-79l"     # Franco's Password
 DEVICE_ID = "ESP32_00"
 
+# MQTT feed for the live stream
+MQTT_BROKER = os.getenv("MQTT_BROKER", "localhost")
+MQTT_PORT = int(os.getenv("MQTT_PORT", 1883))
+MQTT_TOPIC = "channels/+/publish"
+STREAM_HEARTBEAT_S = 15     # Keeps idle SSE connections open through proxies
+PLOT_POINTS = 100           # Points kept on the live plot
+
 # REAL-TIME METRICS STORAGE
 current_metrics = {
     "avg_download": 0,
@@ -64,11 +74,161 @@ def init_db():
             PRIMARY KEY (device_id, ts)
         )
     """)
+    # Insert-ordered id, watermark for incremental readers (Analytics CoverageEngine)
+    cur.execute("ALTER TABLE network_data ADD COLUMN IF NOT EXISTS id BIGSERIAL")
+    cur.execute("CREATE UNIQUE INDEX IF NOT EXISTS network_data_id_idx ON network_data (id)")
+    # Latency tracing columns (UTC epoch ms), added in place on older tables
+    cur.execute("""
+        ALTER TABLE network_data
+            ADD COLUMN IF NOT EXISTS seq BIGINT,
+            ADD COLUMN IF NOT EXISTS boot_id BIGINT,
+            ADD COLUMN IF NOT EXISTS t_sample_ms BIGINT,
+            ADD COLUMN IF NOT EXISTS t_publish_ms BIGINT,
+            ADD COLUMN IF NOT EXISTS t_receive_ms BIGINT,
+            ADD COLUMN IF NOT EXISTS t_commit_ms BIGINT
+    """)
+    # Boot-to-first-publish time, one row per publisher boot
+    cur.execute("""
+        CREATE TABLE IF NOT EXISTS boot_metrics (
+            device_id TEXT NOT NULL,
+            boot_id BIGINT NOT NULL,
+            boot_ms BIGINT,
+            wifi TEXT,
+            received_at TIMESTAMP NOT NULL DEFAULT now(),
+            PRIMARY KEY (device_id, boot_id)
+        )
+    """)
+    # Per-AP survey results (publisher survey mode)
+    cur.execute("""
+        CREATE TABLE IF NOT EXISTS ap_survey (
+            device_id TEXT NOT NULL,
+            ts TIMESTAMP NOT NULL,
+            bssid TEXT NOT NULL,
+            rssi DOUBLE PRECISION,
+            channel INTEGER,
+            lat DOUBLE PRECISION,
+            lon DOUBLE PRECISION,
+            PRIMARY KEY (device_id, ts, bssid)
+        )
+    """)
     conn.commit()
     cur.close()
     conn.close()
 
 
+# LIVE STREAM (Server-Sent Events)
+# Running aggregates, seeded once from the DB and then updated from MQTT,
+# so viewers never hit PostgreSQL
+live = {
+    "sum_down": 0.0, "n_down": 0,
+    "sum_up": 0.0, "n_up": 0,
+    "num_queries": 0,
+}
+recent = deque(maxlen=PLOT_POINTS)      # Last samples, replayed to new viewers
+subscribers = set()                     # One queue per connected viewer
+live_lock = threading.Lock()
+
+
+def live_metrics():
+    return {
+        "avg_download": live["sum_down"] / live["n_down"] if live["n_down"] else 0.0,
+        "avg_upload": live["sum_up"] / live["n_up"] if live["n_up"] else 0.0,
+        "num_queries": live["num_queries"],
+        "current_time": datetime.now().strftime("%H:%M:%S"),
+    }
+
+
+def seed_live():
+    conn = get_db_connection()
+    cur = conn.cursor()
+    cur.execute("""
+        SELECT COALESCE(SUM(down), 0), COUNT(down), COALESCE(SUM(up), 0), COUNT(up), COUNT(*)
+        FROM network_data
+    """)
+    row = cur.fetchone()
+    cur.execute("""
+        SELECT device_id, rssi, down, up, lat, lon, ts
+        FROM network_data
+        WHERE lat IS NOT NULL AND lon IS NOT NULL
+        ORDER BY ts DESC
+        LIMIT %s
+    """, (PLOT_POINTS,))
+    rows = cur.fetchall()
+    cur.close()
+    conn.close()
+
+    with live_lock:
+        live["sum_down"], live["n_down"] = float(row[0]), row[1]
+        live["sum_up"], live["n_up"] = float(row[2]), row[3]
+        live["num_queries"] = row[4]
+        for r in reversed(rows):
+            recent.append({
+                "device_id": r[0], "rssi": r[1], "down": r[2], "up": r[3],
+                "lat": r[4], "lon": r[5], "ts": str(r[6]),
+            })
+
+
+def parse_sample(payload):
+    # field1=rssi&field2=down&field3=up&field4=lat&field5=lon&field6=unix&field7=device
+    pairs = dict(parse_qsl(payload))
+
+    def num(key):
+        try:
+            return float(pairs[key])
+        except (KeyError, ValueError):
+            return None
+
+    ts = pairs.get("field6", "")
+    try:
+        ts = str(datetime.utcfromtimestamp(float(ts)))
+    except ValueError:
+        pass
+
+    return {
+        "device_id": pairs.get("field7"),
+        "rssi": num("field1"), "down": num("field2"), "up": num("field3"),
+        "lat": num("field4"), "lon": num("field5"), "ts": ts,
+    }
+
+
+def publish_event(event):
+    # Fan-out only, a slow viewer's full queue drops the event instead of blocking MQTT
+    data = f"event: update\ndata: {json.dumps(event)}\n\n"
+    for q in list(subscribers):
+        try:
+            q.put_nowait(data)
+        except queue.Full:
+            pass
+
+
+def on_mqtt_message(client, userdata, msg):
+    try:
+        sample = parse_sample(msg.payload.decode("utf-8", errors="ignore"))
+        with live_lock:
+            if sample["down"] is not None:
+                live["sum_down"] += sample["down"]
+                live["n_down"] += 1
+            if sample["up"] is not None:
+                live["sum_up"] += sample["up"]
+                live["n_up"] += 1
+            live["num_queries"] += 1
+            if sample["lat"] is not None and sample["lon"] is not None:
+                recent.append(sample)
+            event = {"sample": sample, "metrics": live_metrics()}
+        publish_event(event)
+    except Exception as e:
+        print("ERROR in MQTT stream:", e)
+
+
+def start_mqtt_feed():
+    client = mqtt.Client(client_id="local_server_stream")
+    client.on_connect = lambda c, u, f, rc: c.subscribe(MQTT_TOPIC)
+    client.on_message = on_mqtt_message
+    client.connect_async(MQTT_BROKER, MQTT_PORT, keepalive=60)
+    client.loop_start()     # Network loop in its own thread, reconnects on its own
+    return client
+
+
 # ROUTES
 
 # Serve test file (download speed)
@@ -154,6 +314,29 @@ def metrics():
     })
 
 
+# Live stream (SSE): snapshot on connect, then one "update" event per ingested sample
+@app.route('/stream', methods=['GET'])
+def stream():
+    q = queue.Queue(maxsize=256)
+    with live_lock:
+        snapshot = {"samples": list(recent), "metrics": live_metrics()}
+        subscribers.add(q)
+
+    def events():
+        try:
+            yield f"event: snapshot\ndata: {json.dumps(snapshot)}\n\n"
+            while True:
+                try:
+                    yield q.get(timeout=STREAM_HEARTBEAT_S)
+                except queue.Empty:
+                    yield ": keepalive\n\n"
+        finally:
+            subscribers.discard(q)
+
+    return Response(events(), mimetype="text/event-stream",
+                    headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"})
+
+
 # Live plot (Plotly 3D) with real data
 @app.route("/plot")
 def live_plot():
@@ -176,8 +359,8 @@ def live_plot():
     if not rows:
         return "<h3>No data available for plotting.</h3>"
 
-    # Create DataFrame
-    df = pd.DataFrame(rows, columns=["device_id", "lat", "lon", "down", "up", "ts"])
+    # Create DataFrame, oldest first so streamed samples append after the newest point
+    df = pd.DataFrame(rows, columns=["device_id", "lat", "lon", "down", "up", "ts"]).iloc[::-1]
 
     # Choose which throughput to plot (e.g., download)
     df["throughput"] = df["down"].fillna(0)
@@ -208,11 +391,26 @@ def live_plot():
     fig.update_layout(scene_camera=dict(eye=dict(x=-1.6, y=-1.6, z=1.2)))
 
 
-    # Auto-refresh every second
+    # Live updates: appends streamed samples to the trace instead of reloading the figure
+    live_script = """
+    const gd = document.getElementById('{plot_id}');
+    const es = new EventSource('/stream');
+    es.addEventListener('update', (e) => {
+        const s = JSON.parse(e.data).sample;
+        if (s.lat === null || s.lon === null) return;
+        const z = s.down === null ? 0 : s.down;
+        Plotly.extendTraces(gd, {
+            x: [[s.lat]], y: [[s.lon]], z: [[z]],
+            'marker.color': [[z]],
+            customdata: [[[s.device_id, s.down, s.up, s.ts]]]
+        }, [0], %d);
+    });
+    """ % PLOT_POINTS
+
     html = f"""
     <html>
       <body>
-        {fig.to_html(include_plotlyjs='cdn', full_html=False)}
+        {fig.to_html(include_plotlyjs='cdn', full_html=False, post_script=live_script)}
       </body>
     </html>
     """
@@ -306,5 +504,9 @@ if __name__ == "__main__":
     # Initialize DB table
     init_db()
 
+    # Live stream: aggregates from the DB once, then from MQTT
+    seed_live()
+    start_mqtt_feed()
+
     print("Running server on http://localhost:8080")
-    app.run(host='0.0.0.0', port=8080)
+    app.run(host='0.0.0.0', port=8080, threaded=True)
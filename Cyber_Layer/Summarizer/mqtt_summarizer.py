@@ -0,0 +1,197 @@
+# Mqtt summarizer, republishes downsampled per-device and fleet summaries
+# --- Imports ---
+import logging
+import os
+import threading
+import time
+from urllib.parse import parse_qsl
+
+import paho.mqtt.client as mqtt
+
+# --- CONFIG ---
+# Mqtt environment variables
+MQTT_BROKER = os.getenv("MQTT_BROKER", "localhost")         # Location of the Mqtt broker
+MQTT_PORT = int(os.getenv("MQTT_PORT", 1883))               # Port of the broker
+MQTT_TOPIC = os.getenv("MQTT_TOPIC", "channels/+/publish")  # Raw samples from every channel
+MQTT_QOS = 1
+# Summary publishing
+SUMMARY_INTERVAL = float(os.getenv("SUMMARY_INTERVAL", 5))  # Seconds between summaries
+SUMMARY_SUFFIX = "summary"                                  # channels/<id>/summary and channels/<id>/summary/<device>
+
+# --- Logging ---
+# timestamps
+logging.basicConfig(level=logging.INFO, format="%(asctime)s %(levelname)s %(message)s")
+
+
+# --- Aggregation state ---
+class DeviceStats:
+    """
+    Accumulates one device's samples between two summary ticks,
+    and keeps its last known position / timestamp.
+    """
+
+    def __init__(self):
+        self.n = 0
+        self.sums = {"rssi": 0.0, "down": 0.0, "up": 0.0}
+        self.counts = {"rssi": 0, "down": 0, "up": 0}
+        self.lat = None
+        self.lon = None
+        self.ts = ""
+        self.seen = 0.0         # Arrival time of the last sample
+
+    def add(self, sample):
+        self.n += 1
+        for k in self.sums:
+            if sample[k] is not None:
+                self.sums[k] += sample[k]
+                self.counts[k] += 1
+        if sample["lat"] is not None:
+            self.lat, self.lon = sample["lat"], sample["lon"]
+        if sample["ts"]:
+            self.ts = sample["ts"]
+        self.seen = time.monotonic()
+
+    def avg(self, k):
+        return self.sums[k] / self.counts[k] if self.counts[k] else None
+
+    def reset(self):
+        self.n = 0
+        self.sums = dict.fromkeys(self.sums, 0.0)
+        self.counts = dict.fromkeys(self.counts, 0)
+
+
+# channel -> device_id -> DeviceStats
+channels = {}
+lock = threading.Lock()     # paho callbacks run on the network thread
+
+
+# --- Payload parsing / encoding ---
+def parse_payload(payload_str):
+    """
+    Parses MQTT payload like:
+    field1=rssi&field2=down&field3=up&field4=lat&field5=lon&field6=unix&field7=device
+    """
+    pairs = dict(parse_qsl(payload_str))
+
+    def num(key):
+        try:
+            return float(pairs[key])
+        except (KeyError, ValueError):
+            return None
+
+    return {
+        "rssi": num("field1"),
+        "down": num("field2"),
+        "up":   num("field3"),
+        "lat":  num("field4"),
+        "lon":  num("field5"),
+        "ts":   pairs.get("field6", ""),
+        "device_id": pairs.get("field7"),
+    }
+
+
+def fmt(v):
+    return "" if v is None else f"{v:.2f}"
+
+
+def encode(fields):
+    """
+    Keeps the raw field1..field7 layout so the Consumer's parsePayload() reads summaries unchanged,
+    field8 carries the number of samples summarized.
+    """
+    return "&".join(f"field{i}={v}" for i, v in enumerate(fields, start=1))
+
+
+# --- Summaries ---
+def publish_summaries(client):
+    with lock:
+        snapshot = {
+            ch: {dev: (s.n, s.avg("rssi"), s.avg("down"), s.avg("up"), s.lat, s.lon, s.ts, s.seen)
+                 for dev, s in devs.items() if s.n}
+            for ch, devs in channels.items()
+        }
+        for devs in channels.values():
+            for s in devs.values():
+                s.reset()
+
+    for ch, devs in snapshot.items():
+        if not devs:
+            continue    # Nothing new, retained summary stays valid
+
+        # Per-device: averages over the interval, last position and timestamp
+        for dev, (n, rssi, down, up, lat, lon, ts, _) in devs.items():
+            msg = encode([fmt(rssi), fmt(down), fmt(up), fmt(lat), fmt(lon), ts, dev, n])
+            client.publish(f"channels/{ch}/{SUMMARY_SUFFIX}/{dev}", msg, qos=MQTT_QOS, retain=True)
+
+        # Fleet: sample-weighted averages, active device count in field4, most recent device in field6/7
+        total = sum(v[0] for v in devs.values())
+
+        def fleet_avg(i):
+            vals = [(v[0], v[i]) for v in devs.values() if v[i] is not None]
+            n = sum(c for c, _ in vals)
+            return sum(c * x for c, x in vals) / n if n else None
+
+        latest = max(devs.items(), key=lambda kv: kv[1][7])      # Most recently heard device
+        msg = encode([fmt(fleet_avg(1)), fmt(fleet_avg(2)), fmt(fleet_avg(3)),
+                      len(devs), "", latest[1][6], latest[0], total])
+        client.publish(f"channels/{ch}/{SUMMARY_SUFFIX}", msg, qos=MQTT_QOS, retain=True)
+        logging.info("Summary | channel=%s | devices=%d | samples=%d", ch, len(devs), total)
+
+
+# --- MQTT callbacks ---
+# Connects to the mqtt broker
+def on_connect(client, userdata, flags, rc):
+    if rc == 0:
+        logging.info("MQTT connected OK. Subscribing to %s", MQTT_TOPIC)
+        client.subscribe(MQTT_TOPIC, qos=MQTT_QOS)
+    else:
+        logging.error("MQTT connection error rc=%s", rc)
+
+# Folds each raw sample into its device's accumulator
+def on_message(client, userdata, msg):
+    try:
+        parts = msg.topic.split("/")        # channels/<id>/publish
+        if len(parts) != 3:
+            return
+        sample = parse_payload(msg.payload.decode("utf-8", errors="ignore"))
+        if not sample["device_id"]:
+            return
+
+        with lock:
+            devs = channels.setdefault(parts[1], {})
+            devs.setdefault(sample["device_id"], DeviceStats()).add(sample)
+
+    # Catches errors
+    except Exception as e:
+        logging.exception("Error in MQTT message handling: %s", e)
+
+
+# --- MAIN ---
+def main():
+    client = mqtt.Client(client_id="mqtt_summarizer")   # Creates MQTT client
+
+    #Registers callback functions
+    logging.info("Connecting to MQTT broker %s:%d ...", MQTT_BROKER, MQTT_PORT)
+    client.on_connect = on_connect
+    client.on_message = on_message
+
+    # Starts the MQTT connection, network loop runs in its own thread
+    client.connect(MQTT_BROKER, MQTT_PORT, keepalive=60)
+    client.loop_start()
+
+    try:
+        # Fixed-interval ticks, independent of how many samples arrive
+        next_tick = time.monotonic() + SUMMARY_INTERVAL
+        while True:
+            time.sleep(max(0.0, next_tick - time.monotonic()))
+            next_tick += SUMMARY_INTERVAL
+            publish_summaries(client)
+    except KeyboardInterrupt:   # Shutdown with Control + C
+        logging.info("Exiting...")
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":      # Only runs as a script
+    main()
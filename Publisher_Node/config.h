@@ -7,10 +7,26 @@
 const char* WIFI_SSID_VAR     = "Tec-IoT";                      //Network name
 const char* WIFI_PASSWORD_VAR = "spotless.magnetic.bridge";     //Network password
 
+// Fast start: reconnect to the cached BSSID/channel (and DHCP lease) saved in NVS
+const uint32_t WIFI_LEASE_MAX_AGE_S = 3600;     // Skip DHCP with a lease younger than this, keep below the AP's lease time (0 = always DHCP)
+const uint32_t WIFI_FAST_TIMEOUT_MS = 3000;     // Cached attempt budget before falling back to scan + DHCP
+const int      MQTT_FAIL_LIMIT      = 3;        // Failed MQTT connects on a cached link before rejoining with scan + DHCP
+
+// AP survey: async single-channel scans between throughput probes, top-N BSSIDs sent with each cycle
+const bool     SURVEY_ENABLED       = false;
+const uint8_t  SURVEY_CHANNELS[]    = {1, 6, 11};   // One channel per scan, keeps each off-channel slot short
+const uint8_t  SURVEY_NUM_CHANNELS  = sizeof(SURVEY_CHANNELS) / sizeof(SURVEY_CHANNELS[0]);
+const uint32_t SURVEY_MS_PER_CHAN   = 120;          // Active dwell time per scan
+const uint32_t SURVEY_GUARD_MS      = 500;          // No scan starts this close to a throughput probe
+#define        SURVEY_TOP_N           5             // BSSIDs reported per cycle
+
 // WiFi test servers
 const char* DOWNLOAD_URL = "http://10.50.77.144:8080/testfile.bin"; //Local IPv4 Adress w/ port
 const char* UPLOAD_URL   = "http://10.50.77.144:8080/upload";       //Local IPv4 adrees w/ port
 
+// Time source for latency tracing (UTC, millisecond stamps in the payload)
+const char* NTP_SERVER = "pool.ntp.org";    // GPS time is used until SNTP syncs
+
 // MQTT credentials
 const char* MQTT_SERVER   = "10.50.77.144";     // MQTT Server direction - local IPv4
 const int   MQTT_PORT     = 1883;               // Non-secure MQTT
@@ -0,0 +1,187 @@
+#pragma once
+
+// Fast WiFi (re)connect logic, no Arduino dependencies so it builds on the host.
+// main.h provides the ESP32 implementations of WifiPort and CacheStore.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/************************************************
+ *                CACHED ASSOCIATION
+ ***********************************************/
+struct WifiCache {
+    uint32_t ssidHash;      // Cache only applies to the network it was taken on
+    uint8_t  bssid[6];      // AP to join directly, skips the scan
+    int32_t  channel;
+    uint32_t ip, gateway, subnet, dns;  // Last DHCP lease, 0 = not cached
+    uint32_t leaseObtained;             // UTC seconds when DHCP handed out ip, 0 = unknown
+    uint32_t checksum;
+};
+
+// FNV-1a, used for the SSID hash and the cache checksum
+inline uint32_t fnv1a(const void* data, size_t len, uint32_t h = 2166136261u) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+inline uint32_t ssidHash(const char* ssid) {
+    return fnv1a(ssid, strlen(ssid));
+}
+
+inline uint32_t cacheChecksum(const WifiCache& c) {
+    return fnv1a(&c, offsetof(WifiCache, checksum));
+}
+
+inline void sealCache(WifiCache& c) {
+    c.checksum = cacheChecksum(c);
+}
+
+inline bool cacheValid(const WifiCache& c, const char* ssid) {
+    return c.checksum == cacheChecksum(c) && c.ssidHash == ssidHash(ssid) && c.channel > 0 && c.channel <= 14;
+}
+
+// The cached IP may only be set statically while the lease is surely still ours
+// The real lease time is not exposed, maxAgeS must stay below the DHCP server's lease
+inline bool leaseValid(const WifiCache& c, uint32_t nowS, uint32_t maxAgeS) {
+    return c.ip && c.leaseObtained && nowS >= c.leaseObtained && nowS - c.leaseObtained < maxAgeS;
+}
+
+/************************************************
+ *                ABSTRACTIONS
+ ***********************************************/
+// Radio side: association attempts and current link state
+class WifiPort {
+public:
+    virtual ~WifiPort() {}
+    virtual void beginCached(const WifiCache& c, bool reuseIp) = 0;  // Join BSSID/channel, static IP if reuseIp, else DHCP
+    virtual void beginFull() = 0;                                   // Scan + DHCP
+    virtual bool connected() = 0;
+    virtual uint32_t millis() = 0;
+    virtual uint32_t epochSeconds() = 0;                            // UTC wall clock, 0 = not known yet
+    virtual void idle() = 0;                                        // Yield while waiting
+    virtual bool snapshot(WifiCache& c) = 0;                        // Current BSSID/channel/lease
+};
+
+// Persistent storage for the cache (NVS on the ESP32)
+class CacheStore {
+public:
+    virtual ~CacheStore() {}
+    virtual bool load(WifiCache& c) = 0;
+    virtual void save(const WifiCache& c) = 0;
+    virtual void clear() = 0;
+};
+
+/************************************************
+ *                FAST CONNECT
+ ***********************************************/
+enum class ConnectPath { NONE, CACHED, FULL };
+
+// Two phases so callers can do other work (GPS warm-up) while the radio associates:
+// start() kicks off the cached or full attempt, finish() waits and falls back if needed.
+class FastConnect {
+public:
+    // leaseMaxAgeS = 0 never reuses the IP, only BSSID/channel
+    FastConnect(WifiPort& port, CacheStore& store, const char* ssid, uint32_t leaseMaxAgeS)
+        : port(port), store(store), ssid(ssid), leaseMaxAgeS(leaseMaxAgeS) {}
+
+    void start() {
+        startedAt = port.millis();
+        haveCache = haveCache || (store.load(cache) && cacheValid(cache, ssid));
+        if (haveCache) {
+            path = ConnectPath::CACHED;
+            staticIp = leaseValid(cache, port.epochSeconds(), leaseMaxAgeS);
+            port.beginCached(cache, staticIp);
+        } else {
+            path = ConnectPath::FULL;
+            port.beginFull();
+        }
+    }
+
+    // fastTimeoutMs bounds the cached attempt, fullTimeoutMs = 0 waits forever on the full path
+    ConnectPath finish(uint32_t fastTimeoutMs, uint32_t fullTimeoutMs = 0) {
+        if (path == ConnectPath::CACHED) {
+            if (waitFor(startedAt, fastTimeoutMs)) return done();
+
+            // Stale cache (AP moved channel...): drop it and do it the slow way
+            dropCache();
+            fullStartedAt = port.millis();
+        } else {
+            fullStartedAt = startedAt;
+        }
+
+        if (waitFor(fullStartedAt, fullTimeoutMs)) return done();
+        path = ConnectPath::NONE;
+        return path;
+    }
+
+    // Blocking reconnect after an outage, uses the in-memory cache
+    ConnectPath reconnect(uint32_t fastTimeoutMs, uint32_t fullTimeoutMs = 0) {
+        start();
+        return finish(fastTimeoutMs, fullTimeoutMs);
+    }
+
+    // Link is up but the network behind it is not (IP taken by another client, wrong gateway...):
+    // drop the cache and rejoin with scan + DHCP
+    ConnectPath fallbackFull(uint32_t fullTimeoutMs = 0) {
+        startedAt = fullStartedAt = port.millis();
+        dropCache();
+        if (waitFor(fullStartedAt, fullTimeoutMs)) return done();
+        path = ConnectPath::NONE;
+        return path;
+    }
+
+    ConnectPath lastPath() const { return path; }
+    bool usedStaticIp() const { return path == ConnectPath::CACHED && staticIp; }
+    uint32_t elapsedMs() { return port.millis() - startedAt; }
+
+private:
+    void dropCache() {
+        store.clear();
+        haveCache = false;
+        staticIp = false;
+        path = ConnectPath::FULL;
+        port.beginFull();
+    }
+
+    bool waitFor(uint32_t since, uint32_t timeoutMs) {
+        while (!port.connected()) {
+            if (timeoutMs && port.millis() - since >= timeoutMs) return false;
+            port.idle();
+        }
+        return true;
+    }
+
+    // Refreshes the cache when association or lease changed
+    ConnectPath done() {
+        WifiCache now;
+        memset(&now, 0, sizeof(now));
+        if (port.snapshot(now)) {
+            now.ssidHash = ssidHash(ssid);
+            // A statically set IP is not a new lease, keep its original age
+            now.leaseObtained = usedStaticIp() ? cache.leaseObtained : port.epochSeconds();
+            sealCache(now);
+            if (!haveCache || memcmp(&now, &cache, sizeof(now)) != 0) {
+                store.save(now);
+                cache = now;
+                haveCache = true;
+            }
+        }
+        return path;
+    }
+
+    WifiPort& port;
+    CacheStore& store;
+    const char* ssid;
+    uint32_t leaseMaxAgeS;
+
+    WifiCache cache;
+    bool haveCache{false};
+    bool staticIp{false};
+    ConnectPath path{ConnectPath::NONE};
+    uint32_t startedAt{0}, fullStartedAt{0};
+};
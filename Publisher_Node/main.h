@@ -1,15 +1,18 @@
 #pragma once
 
 #include <WiFi.h>
+#include <Preferences.h>
 #include <HTTPClient.h>
 #include <PubSubClient.h>
 #include <TinyGPSPlus.h>
 #include <TimeLib.h>
 #include <Adafruit_SSD1306.h>
 #include <math.h>
+#include <sys/time.h>
 #include <Wire.h>
 
 #include "config.h"   // WiFi + MQTT credentials
+#include "fast_start.h"   // Cached WiFi association logic
 
 /************************************************
  *                GLOBAL VARIABLES
@@ -41,15 +44,109 @@ long lastPub{0}, lastPrint{0};      // To hold the value of last call of the mil
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
 
+// -------- Fast start --------
+class EspWifiPort : public WifiPort {
+public:
+    void beginCached(const WifiCache& c, bool reuseIp) override {
+        WiFi.mode(WIFI_STA);
+        if (reuseIp && c.ip) {
+            WiFi.config(IPAddress(c.ip), IPAddress(c.gateway), IPAddress(c.subnet), IPAddress(c.dns));
+        } else {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);     // A static IP from an earlier attempt sticks across begin()
+        }
+        WiFi.begin(WIFI_SSID_VAR, WIFI_PASSWORD_VAR, c.channel, c.bssid, true);
+    }
+    void beginFull() override {
+        WiFi.disconnect();
+        WiFi.mode(WIFI_STA);
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);     // Back to DHCP
+        WiFi.begin(WIFI_SSID_VAR, WIFI_PASSWORD_VAR);
+    }
+    bool connected() override { return WiFi.status() == WL_CONNECTED; }
+    uint32_t millis() override { return ::millis(); }
+    uint32_t epochSeconds() override {
+        time_t t = time(nullptr);
+        return t > 1600000000 ? (uint32_t)t : 0;    // SNTP synced (survives reconnects, not power cycles)
+    }
+    void idle() override { delay(50); }
+    bool snapshot(WifiCache& c) override {
+        uint8_t* bssid = WiFi.BSSID();
+        if (!bssid) return false;
+        memcpy(c.bssid, bssid, sizeof(c.bssid));
+        c.channel = WiFi.channel();
+        c.ip      = (uint32_t)WiFi.localIP();
+        c.gateway = (uint32_t)WiFi.gatewayIP();
+        c.subnet  = (uint32_t)WiFi.subnetMask();
+        c.dns     = (uint32_t)WiFi.dnsIP();
+        return true;
+    }
+};
+
+class NvsCacheStore : public CacheStore {
+public:
+    bool load(WifiCache& c) override {
+        prefs.begin("wifi", true);
+        size_t n = prefs.getBytes("cache", &c, sizeof(c));
+        prefs.end();
+        return n == sizeof(c);
+    }
+    void save(const WifiCache& c) override {
+        prefs.begin("wifi", false);
+        prefs.putBytes("cache", &c, sizeof(c));
+        prefs.end();
+    }
+    void clear() override {
+        prefs.begin("wifi", false);
+        prefs.remove("cache");
+        prefs.end();
+    }
+private:
+    Preferences prefs;
+};
+
+EspWifiPort   wifiPort;
+NvsCacheStore wifiStore;
+FastConnect   fastConnect(wifiPort, wifiStore, WIFI_SSID_VAR, WIFI_LEASE_MAX_AGE_S);
+
+// Boot-to-first-publish time, published once per boot
+long bootToPublish{-1};
+
+// -------- Latency tracing --------
+uint32_t seqNo{0};                  // Per-boot sequence number, gaps mean lost samples
+uint32_t bootId{0};                 // Incremented in NVS every boot, scopes seqNo
+uint64_t gpsEpochMs{0};             // GPS UTC at gpsSyncMillis, used while SNTP is not synced
+unsigned long gpsSyncMillis{0};
+
+// -------- AP survey --------
+struct ApSeen {
+    uint8_t bssid[6];
+    int8_t  rssi;
+    uint8_t channel;
+};
+ApSeen surveyTop[SURVEY_TOP_N];     // Strongest BSSIDs of the cycle in progress, sorted by RSSI
+ApSeen surveyReady[SURVEY_TOP_N];   // Last completed cycle, sent with the next publish
+int  surveyCount{0}, surveyReadyCount{0};
+int  surveyChanIdx{0};
+bool surveyRunning{false};
+
 /************************************************
  *                FUNCTION PROTOTYPES
  ***********************************************/
+void startWiFi();
 void connectWiFi();
 
 float getRSSI();
 float getThroughputDown();
 float getThroughputUp();
 
+void initTracing();
+uint64_t epochMs();
+String u64(uint64_t v);
+
+void surveyInsert(const uint8_t* bssid, int8_t rssi, uint8_t channel);
+void surveyLoop();
+String surveyEncode();
+
 void gps_init();
 void gps_read();
 void serial_gps();
@@ -66,17 +163,17 @@ void app_loop();
 /************************************************
  *                WIFI FUNCTIONS
  ***********************************************/
-void connectWiFi() {
+// Starts association (cached BSSID/channel when available) without waiting for it
+void startWiFi() {
     Serial.println("Connecting to WiFi...");
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID_VAR, WIFI_PASSWORD_VAR);
+    fastConnect.start();
+}
 
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
+// Waits for the association started by startWiFi(), falls back to scan + DHCP on a stale cache
+void connectWiFi() {
+    ConnectPath path = fastConnect.finish(WIFI_FAST_TIMEOUT_MS);
 
-    Serial.println("\nWiFi Connected!");
+    Serial.printf("\nWiFi Connected! (%s, %lu ms)\n", path == ConnectPath::CACHED ? "cached" : "full", (unsigned long)fastConnect.elapsedMs());
     Serial.print("IP: ");
     Serial.println(WiFi.localIP());
 }
@@ -165,6 +262,111 @@ float getThroughputUp() {
     return mbps;
 }
 
+/************************************************
+ *                TRACING FUNCTIONS
+ ***********************************************/
+void initTracing() {
+    Preferences prefs;
+    prefs.begin("trace", false);
+    bootId = prefs.getUInt("boot", 0) + 1;
+    prefs.putUInt("boot", bootId);
+    prefs.end();
+
+    configTime(0, 0, NTP_SERVER);       // UTC, syncs in the background once WiFi is up
+}
+
+// UTC milliseconds, 0 when no time source is available yet
+uint64_t epochMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if (tv.tv_sec > 1600000000) return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    if (gpsEpochMs) return gpsEpochMs + (millis() - gpsSyncMillis);
+    return 0;
+}
+
+String u64(uint64_t v) {
+    char buf[21];
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+    return String(buf);
+}
+
+/************************************************
+ *                AP SURVEY FUNCTIONS
+ ***********************************************/
+// Keeps the top-N by RSSI, one entry per BSSID (strongest reading)
+void surveyInsert(const uint8_t* bssid, int8_t rssi, uint8_t channel) {
+    int pos = -1;
+    for (int i = 0; i < surveyCount; i++) {
+        if (memcmp(surveyTop[i].bssid, bssid, 6) == 0) { pos = i; break; }
+    }
+    if (pos >= 0) {
+        if (rssi <= surveyTop[pos].rssi) return;
+    } else if (surveyCount < SURVEY_TOP_N) {
+        pos = surveyCount++;
+    } else if (rssi > surveyTop[SURVEY_TOP_N - 1].rssi) {
+        pos = SURVEY_TOP_N - 1;
+    } else {
+        return;
+    }
+
+    // Shift weaker entries down and place the reading
+    while (pos > 0 && surveyTop[pos - 1].rssi < rssi) {
+        surveyTop[pos] = surveyTop[pos - 1];
+        pos--;
+    }
+    memcpy(surveyTop[pos].bssid, bssid, 6);
+    surveyTop[pos].rssi = rssi;
+    surveyTop[pos].channel = channel;
+}
+
+// Non-blocking: starts one async scan or collects its results, called every loop
+void surveyLoop() {
+    if (!SURVEY_ENABLED) return;
+
+    if (surveyRunning) {
+        int16_t n = WiFi.scanComplete();
+        if (n == WIFI_SCAN_RUNNING) return;
+
+        for (int16_t i = 0; i < n; i++) {
+            surveyInsert(WiFi.BSSID(i), (int8_t)WiFi.RSSI(i), (uint8_t)WiFi.channel(i));
+        }
+        WiFi.scanDelete();
+        surveyRunning = false;
+
+        // Every channel visited: publish this cycle, start a new one
+        if (++surveyChanIdx >= SURVEY_NUM_CHANNELS) {
+            surveyChanIdx = 0;
+            memcpy(surveyReady, surveyTop, sizeof(surveyTop));
+            surveyReadyCount = surveyCount;
+            surveyCount = 0;
+        }
+        return;
+    }
+
+    // Leave the radio on-channel right before a throughput probe
+    if (millis() - lastPub + SURVEY_GUARD_MS > 1000 * delayPub) return;
+
+    // async, no hidden, active scan of a single channel
+    if (WiFi.scanNetworks(true, false, false, SURVEY_MS_PER_CHAN, SURVEY_CHANNELS[surveyChanIdx]) == WIFI_SCAN_RUNNING) {
+        surveyRunning = true;
+    }
+}
+
+// "aabbccddeeff,-67,6|..." strongest first, empty when no cycle completed since the last publish
+String surveyEncode() {
+    String out;
+    char buf[24];
+    for (int i = 0; i < surveyReadyCount; i++) {
+        const ApSeen& ap = surveyReady[i];
+        snprintf(buf, sizeof(buf), "%s%02x%02x%02x%02x%02x%02x,%d,%u", i ? "|" : "",
+                 ap.bssid[0], ap.bssid[1], ap.bssid[2], ap.bssid[3], ap.bssid[4], ap.bssid[5],
+                 ap.rssi, ap.channel);
+        out += buf;
+    }
+    surveyReadyCount = 0;
+    return out;
+}
+
 /************************************************
  *                GPS FUNCTIONS
  ***********************************************/
@@ -183,6 +385,18 @@ void gps_read() {
             char c = SerialGPS.read();
             gps.encode(c);
         }
+        //Fallback clock for tracing, checked before the reads below clear the updated flag
+        if (gps.time.isUpdated() && gps.time.isValid() && gps.date.isValid()) {
+            tmElements_t tm;
+            tm.Year = CalendarYrToTm(gps.date.year());
+            tm.Month = gps.date.month();
+            tm.Day = gps.date.day();
+            tm.Hour = gps.time.hour();
+            tm.Minute = gps.time.minute();
+            tm.Second = gps.time.second();
+            gpsEpochMs = (uint64_t)makeTime(tm) * 1000 + gps.time.centisecond() * 10;
+            gpsSyncMillis = millis();
+        }
         //Store data
         sat = gps.satellites.value();
         latitude  = gps.location.lat();
@@ -237,6 +451,7 @@ void serial_gps() {
  *                MQTT FUNCTIONS
  ***********************************************/
 void connectMQTT() {
+    int failures = 0;
     while (!mqttClient.connected()) {
         Serial.print("Connecting to MQTT...");
         if (mqttClient.connect(MQTT_CLIENT_ID_VAR, MQTT_USER_VAR, MQTT_PASS_VAR)) {
@@ -244,6 +459,14 @@ void connectMQTT() {
         } else {
             Serial.print("Failed, rc=");
             Serial.println(mqttClient.state());
+
+            // Associated through the cache but the broker is unreachable (e.g. IP now used by another client)
+            if (++failures >= MQTT_FAIL_LIMIT && fastConnect.lastPath() == ConnectPath::CACHED) {
+                Serial.println("Dropping cached WiFi state, rejoining with scan + DHCP");
+                fastConnect.fallbackFull();
+                failures = 0;
+                continue;
+            }
             delay(2000);
         }
     }
@@ -251,21 +474,28 @@ void connectMQTT() {
 
 void setupMQTT() {
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
+    mqttClient.setBufferSize(512);      // Default 256 B is too small once survey results are appended
     connectMQTT();
 }
 
 void loopMQTT() {
+    // WiFi outage: reconnect through the cached association first
+    if (WiFi.status() != WL_CONNECTED) {
+        fastConnect.reconnect(WIFI_FAST_TIMEOUT_MS);
+        Serial.printf("WiFi reconnected in %lu ms\n", (unsigned long)fastConnect.elapsedMs());
+    }
     if (!mqttClient.connected()) connectMQTT();
     mqttClient.loop();
 }
 
 String buildMQTTMessage() {
+    uint64_t sampledAt = epochMs();     // Probes below count toward sample -> publish latency
     float rssi = getRSSI();
     float down = getThroughputDown();
     float up   = getThroughputUp();
 
     setTime(hs, mins, secs, dd, mm, yy);
-    time_t date = now() - 6 * 3600;
+    time_t date = now() - 6 * 3600;     // field6 stays local (UTC-6) seconds for existing readers, t_s/t_p are UTC ms
 
     String msg =
         "field1=" + String(rssi) +
@@ -276,17 +506,34 @@ String buildMQTTMessage() {
         "&field6=" + String(date) +
         "&field7=" + String(DEVICE_ID);
 
+    String aps = surveyEncode();
+    if (aps.length() > 0) msg += "&aps=" + aps;
+
+    msg += "&seq=" + String(seqNo++) + "&boot=" + String(bootId) + "&t_s=" + u64(sampledAt);
+
     return msg;
 }
 
 void publishData() {
+    if (surveyRunning) return;      // Probes wait for the scan to hand the radio back
     if(millis() - lastPub > 1000 * delayPub) {
         lastPub = millis();
         String payload = buildMQTTMessage();
         String topic = String("channels/") + CHANNEL_ID + "/publish";
 
+        payload += "&t_p=" + u64(epochMs());
         Serial.println(payload);
         mqttClient.publish(topic.c_str(), payload.c_str());
+
+        // First sample of this boot: report how long it took, retained per device
+        if (bootToPublish < 0) {
+            bootToPublish = millis();
+            String bootTopic = String("channels/") + CHANNEL_ID + "/boot/" + DEVICE_ID;
+            String bootMsg = String("boot_ms=") + bootToPublish + "&boot=" + bootId +
+                             "&wifi=" + (fastConnect.lastPath() == ConnectPath::CACHED ? "cached" : "full");
+            Serial.println(bootMsg);
+            mqttClient.publish(bootTopic.c_str(), bootMsg.c_str(), true);
+        }
     }
 }
 
@@ -295,7 +542,9 @@ void publishData() {
  ***********************************************/
 void app_setup() {
     Serial.begin(115200);
-    gps_init();
+    initTracing();
+    startWiFi();        // Associates in the background
+    gps_init();         // GPS warm-up overlaps with the association
     connectWiFi();
     setupMQTT();
     Serial.println("System Ready.");
@@ -303,6 +552,7 @@ void app_setup() {
 
 void app_loop() {
     loopMQTT();
+    surveyLoop();
     gps_read();
     serial_gps();
     publishData();
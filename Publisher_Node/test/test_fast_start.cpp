@@ -0,0 +1,228 @@
+// Host test for fast_start.h with fake radio and storage
+// Build and run: make -C Publisher_Node/test
+#include <stdio.h>
+#include "../fast_start.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+/************************************************
+ *                FAKES
+ ***********************************************/
+// Connects after connectAfterMs of fake time when the attempt can succeed
+class FakePort : public WifiPort {
+public:
+    bool cachedWorks{true};
+    uint32_t connectAfterMs{100};
+    uint32_t now{0}, epoch{1700000000};
+    int cachedBegins{0}, fullBegins{0};
+    bool lastReuseIp{false};
+    WifiCache live;             // What snapshot() reports once connected
+
+    FakePort() {
+        memset(&live, 0, sizeof(live));
+        const uint8_t bssid[6] = {1, 2, 3, 4, 5, 6};
+        memcpy(live.bssid, bssid, sizeof(bssid));
+        live.channel = 6;
+        live.ip = 0x0A00000A; live.gateway = 0x0A000001; live.subnet = 0xFFFFFF00; live.dns = 0x0A000001;
+    }
+
+    void beginCached(const WifiCache&, bool reuseIp) override {
+        cachedBegins++;
+        lastReuseIp = reuseIp;
+        attemptOk = cachedWorks;
+        attemptAt = now;
+    }
+    void beginFull() override {
+        fullBegins++;
+        attemptOk = true;
+        attemptAt = now;
+    }
+    bool connected() override { return attemptOk && now - attemptAt >= connectAfterMs; }
+    uint32_t millis() override { return now; }
+    uint32_t epochSeconds() override { return epoch; }
+    void idle() override { now += 10; }
+    bool snapshot(WifiCache& c) override {
+        memcpy(c.bssid, live.bssid, sizeof(c.bssid));
+        c.channel = live.channel;
+        c.ip = live.ip; c.gateway = live.gateway; c.subnet = live.subnet; c.dns = live.dns;
+        return true;
+    }
+
+private:
+    bool attemptOk{false};
+    uint32_t attemptAt{0};
+};
+
+class FakeStore : public CacheStore {
+public:
+    WifiCache blob;
+    bool has{false};
+    int saves{0}, clears{0};
+
+    bool load(WifiCache& c) override {
+        if (has) c = blob;
+        return has;
+    }
+    void save(const WifiCache& c) override { blob = c; has = true; saves++; }
+    void clear() override { has = false; clears++; }
+};
+
+static const char* SSID = "campus";
+static const uint32_t FAST_MS = 3000;
+static const uint32_t MAX_AGE_S = 3600;
+
+// First boot: full path, leaves a sealed cache behind
+static void warmStore(FakePort& port, FakeStore& store) {
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    fc.reconnect(FAST_MS);
+}
+
+/************************************************
+ *                CASES
+ ***********************************************/
+static void testFirstBootSavesCache() {
+    FakePort port; FakeStore store;
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::FULL);
+    CHECK(store.saves == 1);
+    CHECK(cacheValid(store.blob, SSID));
+    CHECK(store.blob.leaseObtained == port.epoch);
+}
+
+static void testValidCacheTakesCachedPath() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    port.epoch += 60;
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::CACHED);
+    CHECK(port.cachedBegins == 1 && port.fullBegins == 1);
+    CHECK(port.lastReuseIp);
+    CHECK(fc.usedStaticIp());
+}
+
+static void testStaleCacheFallsBackToFull() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    port.cachedWorks = false;       // AP moved channel
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::FULL);
+    CHECK(store.clears == 1);
+    CHECK(port.fullBegins == 2);
+    CHECK(store.has && cacheValid(store.blob, SSID));  // Re-taken on the full path
+}
+
+static void testSsidChangeInvalidates() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+
+    FastConnect fc(port, store, "other", MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::FULL);
+    CHECK(port.cachedBegins == 0);
+}
+
+static void testChecksumMismatchInvalidates() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    store.blob.ip ^= 1;             // Corrupted NVS blob
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::FULL);
+    CHECK(port.cachedBegins == 0);
+}
+
+static void testOldLeaseNotReused() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    port.epoch += MAX_AGE_S;
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::CACHED);
+    CHECK(!port.lastReuseIp);       // BSSID/channel only, DHCP runs
+}
+
+// Outage after the lease expired: DHCP again, and only that refreshes the lease age
+static void testExpiredLeaseRenewedByDhcp() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    port.epoch += 60;
+    fc.reconnect(FAST_MS);
+    CHECK(port.lastReuseIp);
+    const uint32_t obtained = store.blob.leaseObtained;
+
+    port.epoch = obtained + MAX_AGE_S;
+    fc.reconnect(FAST_MS);
+    CHECK(!port.lastReuseIp);
+    CHECK(store.blob.leaseObtained == port.epoch);
+
+    port.epoch += 60;
+    fc.reconnect(FAST_MS);
+    CHECK(port.lastReuseIp);
+    CHECK(store.blob.leaseObtained == obtained + MAX_AGE_S);
+}
+
+static void testUnknownClockNotReused() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    port.epoch = 0;                 // Cold boot before SNTP
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    fc.reconnect(FAST_MS);
+    CHECK(!port.lastReuseIp);
+}
+
+static void testSavesOnlyOnChange() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+    const uint32_t obtained = store.blob.leaseObtained;
+
+    // Same association with the reused IP: nothing to write, lease keeps its age
+    port.epoch += 60;
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    fc.reconnect(FAST_MS);
+    fc.reconnect(FAST_MS);
+    CHECK(store.saves == 1);
+    CHECK(store.blob.leaseObtained == obtained);
+
+    // Roamed to another AP
+    port.live.bssid[5] = 7;
+    fc.reconnect(FAST_MS);
+    CHECK(store.saves == 2);
+    CHECK(store.blob.bssid[5] == 7);
+}
+
+static void testFallbackFullDropsCache() {
+    FakePort port; FakeStore store;
+    warmStore(port, store);
+
+    FastConnect fc(port, store, SSID, MAX_AGE_S);
+    CHECK(fc.reconnect(FAST_MS) == ConnectPath::CACHED);
+    CHECK(fc.fallbackFull() == ConnectPath::FULL);      // Broker unreachable on the cached link
+    CHECK(store.clears == 1);
+    CHECK(port.fullBegins == 2);
+    CHECK(store.has && store.blob.leaseObtained == port.epoch);
+}
+
+int main() {
+    testFirstBootSavesCache();
+    testValidCacheTakesCachedPath();
+    testStaleCacheFallsBackToFull();
+    testSsidChangeInvalidates();
+    testChecksumMismatchInvalidates();
+    testOldLeaseNotReused();
+    testExpiredLeaseRenewedByDhcp();
+    testUnknownClockNotReused();
+    testSavesOnlyOnChange();
+    testFallbackFullDropsCache();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("fast_start: all checks passed\n");
+    return 0;
+}